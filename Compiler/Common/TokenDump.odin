@@ -0,0 +1,254 @@
+package Common
+
+import "core:bufio"
+import "core:encoding/endian"
+import "core:encoding/json"
+import "core:io"
+import "core:os"
+import "core:reflect"
+import "core:strings"
+
+// This file defines the machine readable dump formats consumed by external tooling
+
+DumpKind :: enum {
+    TOKENS,
+    AST,
+    IR,
+}
+
+DumpFormat :: enum {
+    JSON_LINES, // One object per token: {"type":"SYMBOL","text":"bob","start":4,"end":7}
+    BINARY,     // Header then one little-endian record per token, see WriteTokensBinary
+}
+
+// Dumps are written through a single large buffer so a whole file costs a handful of writes
+DUMP_BUFFER_SIZE :: 1 << 20
+
+TOKEN_DUMP_MAGIC   :: "DSLT"
+TOKEN_DUMP_VERSION :: 2
+
+// Size of the binary header: magic, version byte, token count
+@(private)
+TOKEN_DUMP_HEADER_SIZE :: len(TOKEN_DUMP_MAGIC) + 1 + 8
+
+// Size of a binary record before the token text: type, start, end, text length
+@(private)
+TOKEN_DUMP_RECORD_SIZE :: 2 + 4 + 4 + 4
+
+@(private)
+TokenDumpRecord :: struct {
+    Type: string `json:"type"`,
+    Text: string `json:"text"`,
+    Start: int   `json:"start"`,
+    End: int     `json:"end"`,
+}
+
+ParseDumpKind :: proc(Text: string) -> (Kind: DumpKind, Ok: bool) {
+    switch Text {
+    case "tokens": return .TOKENS, true
+    case "ast":    return .AST, true
+    case "ir":     return .IR, true
+    }
+    return .TOKENS, false
+}
+
+ParseDumpFormat :: proc(Text: string) -> (Format: DumpFormat, Ok: bool) {
+    switch Text {
+    case "jsonl", "json":  return .JSON_LINES, true
+    case "binary", "bin":  return .BINARY, true
+    }
+    return .JSON_LINES, false
+}
+
+// Writes the token list to the file at Path, replacing it if it exists
+DumpTokensToFile :: proc(Tokens: []Token, Path: string, Format: DumpFormat) -> bool {
+    Handle, Err := os.open(Path, os.O_WRONLY | os.O_CREATE | os.O_TRUNC, 0o644)
+    if Err != nil {
+        return false
+    }
+    defer os.close(Handle)
+
+    return DumpTokens(Tokens, os.stream_from_handle(Handle), Format)
+}
+
+// Writes the token list to Output through a DUMP_BUFFER_SIZE buffered writer
+DumpTokens :: proc(Tokens: []Token, Output: io.Writer, Format: DumpFormat) -> bool {
+    Buffered: bufio.Writer
+    bufio.writer_init(&Buffered, Output, DUMP_BUFFER_SIZE)
+    defer bufio.writer_destroy(&Buffered)
+
+    // bufio keeps the first write error and returns it from the final flush
+    Writer := bufio.writer_to_stream(&Buffered)
+    switch Format {
+    case .JSON_LINES: WriteTokensJSONLines(Tokens, Writer)
+    case .BINARY:     WriteTokensBinary(Tokens, Writer)
+    }
+
+    return bufio.writer_flush(&Buffered) == nil
+}
+
+// Reads a dump written by DumpTokensToFile
+LoadTokenDumpFile :: proc(Path: string, Format: DumpFormat, Allocator := context.allocator) -> (Tokens: [dynamic]Token, Ok: bool) {
+    Data, ReadOk := os.read_entire_file(Path, Allocator)
+    if !ReadOk {
+        return nil, false
+    }
+    defer delete(Data, Allocator)
+
+    return LoadTokenDump(Data, Format, Allocator)
+}
+
+// Reads a dump written by DumpTokens, token texts are copied with Allocator
+LoadTokenDump :: proc(Data: []byte, Format: DumpFormat, Allocator := context.allocator) -> (Tokens: [dynamic]Token, Ok: bool) {
+    Tokens = make([dynamic]Token, Allocator)
+
+    switch Format {
+    case .JSON_LINES: Ok = ReadTokensJSONLines(Data, &Tokens, Allocator)
+    case .BINARY:     Ok = ReadTokensBinary(Data, &Tokens, Allocator)
+    }
+
+    if !Ok {
+        for Tok in Tokens {
+            delete(Tok.Text, Allocator)
+        }
+        delete(Tokens)
+        return nil, false
+    }
+    return Tokens, true
+}
+
+@(private)
+WriteTokensJSONLines :: proc(Tokens: []Token, Writer: io.Writer) {
+    // TokenType starts at 0 with no gaps, so the field names can be indexed by value instead of looked up per token
+    TypeNames: [TokenType]string
+    for Name, Index in reflect.enum_field_names(TokenType) {
+        TypeNames[TokenType(Index)] = Name
+    }
+
+    for Tok in Tokens {
+        io.write_string(Writer, `{"type":"`)
+        io.write_string(Writer, TypeNames[Tok.Type])
+        io.write_string(Writer, `","text":`)
+        WriteJSONString(Writer, Tok.Text)
+        io.write_string(Writer, `,"start":`)
+        io.write_int(Writer, Tok.Start)
+        io.write_string(Writer, `,"end":`)
+        io.write_int(Writer, Tok.End)
+        io.write_string(Writer, "}\n")
+    }
+}
+
+@(private)
+// Writes Text as a quoted JSON string, copying unescaped runs in one write
+WriteJSONString :: proc(Writer: io.Writer, Text: string) {
+    HexDigits := "0123456789abcdef"
+
+    io.write_byte(Writer, '"')
+    RunStart := 0
+    for Index in 0..<len(Text) {
+        Char := Text[Index]
+        if Char != '"' && Char != '\\' && Char >= 0x20 {
+            continue
+        }
+
+        io.write_string(Writer, Text[RunStart:Index])
+        switch Char {
+        case '"':  io.write_string(Writer, `\"`)
+        case '\\': io.write_string(Writer, `\\`)
+        case '\n': io.write_string(Writer, `\n`)
+        case '\r': io.write_string(Writer, `\r`)
+        case '\t': io.write_string(Writer, `\t`)
+        case:
+            io.write_string(Writer, `\u00`)
+            io.write_byte(Writer, HexDigits[Char >> 4])
+            io.write_byte(Writer, HexDigits[Char & 0xF])
+        }
+        RunStart = Index + 1
+    }
+    io.write_string(Writer, Text[RunStart:])
+    io.write_byte(Writer, '"')
+}
+
+@(private)
+// Layout (all integers little-endian):
+//   header: "DSLT" | u8 version | u64 token count
+//   record: u16 token type | u32 start | u32 end | u32 text length in bytes | text bytes
+WriteTokensBinary :: proc(Tokens: []Token, Writer: io.Writer) {
+    Header: [TOKEN_DUMP_HEADER_SIZE]byte
+    copy(Header[:], TOKEN_DUMP_MAGIC)
+    Header[len(TOKEN_DUMP_MAGIC)] = TOKEN_DUMP_VERSION
+    endian.put_u64(Header[len(TOKEN_DUMP_MAGIC) + 1:], .Little, u64(len(Tokens)))
+    io.write(Writer, Header[:])
+
+    Record: [TOKEN_DUMP_RECORD_SIZE]byte
+    for Tok in Tokens {
+        endian.put_u16(Record[0:2], .Little, u16(Tok.Type))
+        endian.put_u32(Record[2:6], .Little, u32(Tok.Start))
+        endian.put_u32(Record[6:10], .Little, u32(Tok.End))
+        endian.put_u32(Record[10:14], .Little, u32(len(Tok.Text)))
+        io.write(Writer, Record[:])
+        io.write_string(Writer, Tok.Text)
+    }
+}
+
+@(private)
+ReadTokensJSONLines :: proc(Data: []byte, Tokens: ^[dynamic]Token, Allocator := context.allocator) -> bool {
+    Remaining := string(Data)
+    for Line in strings.split_lines_iterator(&Remaining) {
+        if len(Line) == 0 {
+            continue
+        }
+
+        Record: TokenDumpRecord
+        if json.unmarshal_string(Line, &Record, allocator = Allocator) != nil {
+            return false
+        }
+        defer delete(Record.Type, Allocator)
+
+        Type, Ok := reflect.enum_from_name(TokenType, Record.Type)
+        if !Ok {
+            delete(Record.Text, Allocator)
+            return false
+        }
+        append(Tokens, Token{Type = Type, Text = Record.Text, Start = Record.Start, End = Record.End})
+    }
+    return true
+}
+
+@(private)
+ReadTokensBinary :: proc(Data: []byte, Tokens: ^[dynamic]Token, Allocator := context.allocator) -> bool {
+    if len(Data) < TOKEN_DUMP_HEADER_SIZE || string(Data[:len(TOKEN_DUMP_MAGIC)]) != TOKEN_DUMP_MAGIC {
+        return false
+    }
+    if Data[len(TOKEN_DUMP_MAGIC)] != TOKEN_DUMP_VERSION {
+        return false
+    }
+
+    Count, _ := endian.get_u64(Data[len(TOKEN_DUMP_MAGIC) + 1:TOKEN_DUMP_HEADER_SIZE], .Little)
+    Offset := TOKEN_DUMP_HEADER_SIZE
+    // Rejects counts that cannot fit in the data before reserving space for them
+    if Count > u64(len(Data) - Offset) / TOKEN_DUMP_RECORD_SIZE {
+        return false
+    }
+    reserve(Tokens, int(Count))
+
+    for _ in 0..<Count {
+        if len(Data) - Offset < TOKEN_DUMP_RECORD_SIZE {
+            return false
+        }
+        RawType, _ := endian.get_u16(Data[Offset:Offset + 2], .Little)
+        Start, _ := endian.get_u32(Data[Offset + 2:Offset + 6], .Little)
+        End, _ := endian.get_u32(Data[Offset + 6:Offset + 10], .Little)
+        TextLength, _ := endian.get_u32(Data[Offset + 10:Offset + 14], .Little)
+        Offset += TOKEN_DUMP_RECORD_SIZE
+
+        if RawType > u16(max(TokenType)) || u64(TextLength) > u64(len(Data) - Offset) {
+            return false
+        }
+        Text := strings.clone(string(Data[Offset:Offset + int(TextLength)]), Allocator)
+        Offset += int(TextLength)
+
+        append(Tokens, Token{Type = TokenType(RawType), Text = Text, Start = int(Start), End = int(End)})
+    }
+    return Offset == len(Data)
+}
@@ -92,10 +92,19 @@ TokenType :: enum {
 Token :: struct {
     
     Text: string,
-    Type: TokenType
+    Type: TokenType,
+    Start: int, // Rune offset of the first rune of the token in the tokenizer input
+    End: int,   // Rune offset one past the last rune of the token
 
 }
 
+// Describes the part of the token list replaced by Compiler.RetokenizeEdit, all other tokens are unchanged
+TokenListEdit :: struct {
+    FirstToken: int,    // Index of the first replaced token
+    RemovedCount: int,  // Number of old tokens removed
+    InsertedCount: int, // Number of re-lexed tokens inserted at FirstToken
+}
+
 
 
 
@@ -12,46 +12,165 @@ import "core:strconv"
 
 import "Common"
 
+// The tokenizer input and the token list are gap buffers so an edit only moves data near the edit.
+// Runes in [CodeGapStart, CodeGapEnd) and tokens in [TokenGapStart, TokenGapEnd) are unused.
 @(private)
 DSLCodeString: [dynamic]rune
+@(private)
+CodeGapStart: int = 0
+@(private)
+CodeGapEnd: int = 0
 
+// Tokens after the gap store Start and End relative to the end of the input (so they are negative),
+// which keeps them correct when the text before them changes length. Use TokenAt or TokenList to read them.
+@(private)
 DSLTokensList: [dynamic]Common.Token
+@(private)
+TokenGapStart: int = 0
+@(private)
+TokenGapEnd: int = 0
 
 @(private)
 CurrentTokenIndex: int = 0
 
+// Furthest MatchToken reads past the rune it starts on, the char literal check looks two runes ahead
+@(private)
+MATCH_TOKEN_LOOKAHEAD :: 2
+
 // Initializes the tokenizer input string
 InitTokenizerCodeString :: proc(SourceCode: string, Allocator := context.allocator) {
     Runes: []rune = utf8.string_to_runes(SourceCode, Allocator)
+    // New source is appended after the existing text, so drop both gaps while the input length is unchanged
+    CloseTokenGap()
+    MoveCodeGap(CodeLength())
+    resize(&DSLCodeString, CodeGapStart)
     for Rune in Runes {
         append(&DSLCodeString, Rune)
     }
+    CodeGapStart = len(DSLCodeString)
+    CodeGapEnd = CodeGapStart
+}
+
+// Number of runes in the tokenizer input
+CodeLength :: proc() -> int {
+    return len(DSLCodeString) - (CodeGapEnd - CodeGapStart)
+}
+
+@(private)
+CodeRuneAt :: proc(Index: int) -> rune {
+    if Index < CodeGapStart {
+        return DSLCodeString[Index]
+    }
+    return DSLCodeString[Index + CodeGapEnd - CodeGapStart]
+}
+
+// Number of tokens produced by Tokenize and RetokenizeEdit
+TokenCount :: proc() -> int {
+    return len(DSLTokensList) - (TokenGapEnd - TokenGapStart)
+}
+
+// Returns the token at Index with absolute Start and End offsets
+TokenAt :: proc(Index: int) -> Common.Token {
+    if Index < TokenGapStart {
+        return DSLTokensList[Index]
+    }
+    Token := DSLTokensList[Index + TokenGapEnd - TokenGapStart]
+    Token.Start += CodeLength()
+    Token.End += CodeLength()
+    return Token
+}
+
+// Returns every token as one slice, valid until the next Tokenize or RetokenizeEdit.
+// This closes the token gap, so it costs time proportional to the tokens after the last edit.
+TokenList :: proc() -> []Common.Token {
+    CloseTokenGap()
+    return DSLTokensList[:]
+}
+
+@(private)
+// Moves the rune gap so it starts at Position, copying only the runes between the old and new position
+MoveCodeGap :: proc(Position: int) {
+    GapSize := CodeGapEnd - CodeGapStart
+    if Position < CodeGapStart {
+        copy(DSLCodeString[Position + GapSize:CodeGapEnd], DSLCodeString[Position:CodeGapStart])
+    } else if Position > CodeGapStart {
+        copy(DSLCodeString[CodeGapStart:Position], DSLCodeString[CodeGapEnd:Position + GapSize])
+    }
+    CodeGapStart = Position
+    CodeGapEnd = Position + GapSize
+}
+
+@(private)
+// Moves the token gap so it starts at token Index, converting the offsets of the tokens that cross it
+MoveTokenGap :: proc(Index: int) {
+    Length := CodeLength()
+    for TokenGapStart > Index {
+        TokenGapStart -= 1
+        TokenGapEnd -= 1
+        Token := DSLTokensList[TokenGapStart]
+        Token.Start -= Length
+        Token.End -= Length
+        DSLTokensList[TokenGapEnd] = Token
+    }
+    for TokenGapStart < Index {
+        Token := DSLTokensList[TokenGapEnd]
+        Token.Start += Length
+        Token.End += Length
+        DSLTokensList[TokenGapStart] = Token
+        TokenGapStart += 1
+        TokenGapEnd += 1
+    }
+}
+
+@(private)
+// Moves the token gap to the end and drops it so the list can be appended to or sliced directly
+CloseTokenGap :: proc() {
+    MoveTokenGap(TokenCount())
+    resize(&DSLTokensList, TokenGapStart)
+    TokenGapEnd = TokenGapStart
+}
+
+@(private)
+// Makes the gap [GapStart, GapEnd) of a gap buffer hold at least MinimumSize elements
+GrowGap :: proc(Buffer: ^[dynamic]$T, GapStart: int, GapEnd: ^int, MinimumSize: int) {
+    GapSize := GapEnd^ - GapStart
+    if GapSize >= MinimumSize {
+        return
+    }
+
+    // Grow by at least half the buffer so a run of insertions stays amortized O(1) per element
+    Extra := max(MinimumSize - GapSize, len(Buffer^) / 2 + 64)
+    OldLength := len(Buffer^)
+    resize(Buffer, OldLength + Extra)
+    copy(Buffer^[GapEnd^ + Extra:], Buffer^[GapEnd^:OldLength])
+    GapEnd^ += Extra
 }
 
 @(private)
-MatchToken :: proc() {
-    if CurrentTokenIndex >= len(DSLCodeString) {
+MatchToken :: proc(Tokens: ^[dynamic]Common.Token) {
+    if CurrentTokenIndex >= CodeLength() {
         return
     }
     
-    Rune: rune = DSLCodeString[CurrentTokenIndex]
+    TokenStart: int = CurrentTokenIndex
+    Rune: rune = CodeRuneAt(CurrentTokenIndex)
     TokenText: [dynamic]rune
     TokenType: Common.TokenType = .INVALID  
 
     if unicode.is_letter(Rune) || Rune == '_' {
         append_elem(&TokenText, Rune)
-        for CurrentTokenIndex + 1 < len(DSLCodeString) && 
-              (unicode.is_letter(DSLCodeString[CurrentTokenIndex + 1]) || unicode.is_digit(DSLCodeString[CurrentTokenIndex + 1]) || DSLCodeString[CurrentTokenIndex + 1] == '_') {
+        for CurrentTokenIndex + 1 < CodeLength() && 
+              (unicode.is_letter(CodeRuneAt(CurrentTokenIndex + 1)) || unicode.is_digit(CodeRuneAt(CurrentTokenIndex + 1)) || CodeRuneAt(CurrentTokenIndex + 1) == '_') {
             CurrentTokenIndex += 1
-            append_elem(&TokenText, DSLCodeString[CurrentTokenIndex])
+            append_elem(&TokenText, CodeRuneAt(CurrentTokenIndex))
         }
         TokenType = ClassifyIdentifier(utf8.runes_to_string(TokenText[:]))
     } 
     else if unicode.is_digit(Rune) {
         append_elem(&TokenText, Rune)
-        for CurrentTokenIndex + 1 < len(DSLCodeString) && unicode.is_digit(DSLCodeString[CurrentTokenIndex + 1]) {
+        for CurrentTokenIndex + 1 < CodeLength() && unicode.is_digit(CodeRuneAt(CurrentTokenIndex + 1)) {
             CurrentTokenIndex += 1
-            append_elem(&TokenText, DSLCodeString[CurrentTokenIndex])
+            append_elem(&TokenText, CodeRuneAt(CurrentTokenIndex))
         }
         TokenType = .INT_32  // Default type (can be adjusted later to specific type)
 
@@ -78,27 +197,27 @@ MatchToken :: proc() {
         }
     } 
     else if Rune == '"' {
-        for CurrentTokenIndex + 1 < len(DSLCodeString) && DSLCodeString[CurrentTokenIndex + 1] != '"' {
+        for CurrentTokenIndex + 1 < CodeLength() && CodeRuneAt(CurrentTokenIndex + 1) != '"' {
             CurrentTokenIndex += 1
-            append_elem(&TokenText, DSLCodeString[CurrentTokenIndex])
+            append_elem(&TokenText, CodeRuneAt(CurrentTokenIndex))
         }
-        if CurrentTokenIndex + 1 < len(DSLCodeString) {
+        if CurrentTokenIndex + 1 < CodeLength() {
             CurrentTokenIndex += 1 
             TokenType = .STRING
         }
     } 
     else if Rune == '\'' {
-        if CurrentTokenIndex + 1 < len(DSLCodeString) && CurrentTokenIndex + 2 < len(DSLCodeString) && DSLCodeString[CurrentTokenIndex + 2] == '\'' {
-            append_elem(&TokenText, DSLCodeString[CurrentTokenIndex + 1])
+        if CurrentTokenIndex + 1 < CodeLength() && CurrentTokenIndex + 2 < CodeLength() && CodeRuneAt(CurrentTokenIndex + 2) == '\'' {
+            append_elem(&TokenText, CodeRuneAt(CurrentTokenIndex + 1))
             CurrentTokenIndex += 2
             TokenType = .CHAR
         }
     } 
-    else if Rune == '#' && CurrentTokenIndex + 1 < len(DSLCodeString) && DSLCodeString[CurrentTokenIndex + 1] == '[' {
-        for CurrentTokenIndex + 1 < len(DSLCodeString) && !(DSLCodeString[CurrentTokenIndex] == ']' && DSLCodeString[CurrentTokenIndex + 1] == '#') {
+    else if Rune == '#' && CurrentTokenIndex + 1 < CodeLength() && CodeRuneAt(CurrentTokenIndex + 1) == '[' {
+        for CurrentTokenIndex + 1 < CodeLength() && !(CodeRuneAt(CurrentTokenIndex) == ']' && CodeRuneAt(CurrentTokenIndex + 1) == '#') {
             CurrentTokenIndex += 1
         }
-        if CurrentTokenIndex + 1 < len(DSLCodeString) {
+        if CurrentTokenIndex + 1 < CodeLength() {
             CurrentTokenIndex += 1 
             TokenType = .COMMENT_END
         }
@@ -106,9 +225,9 @@ MatchToken :: proc() {
     else if IsOperator(Rune) {
         append_elem(&TokenText, Rune)
         // Check for continuation of the operator
-        if CurrentTokenIndex + 1 < len(DSLCodeString) && IsOperatorContinuation(DSLCodeString[CurrentTokenIndex + 1]) {
+        if CurrentTokenIndex + 1 < CodeLength() && IsOperatorContinuation(CodeRuneAt(CurrentTokenIndex + 1)) {
             CurrentTokenIndex += 1
-            append_elem(&TokenText, DSLCodeString[CurrentTokenIndex])
+            append_elem(&TokenText, CodeRuneAt(CurrentTokenIndex))
         }
         TokenType = ClassifyOperator(utf8.runes_to_string(TokenText[:]))
     } 
@@ -118,7 +237,7 @@ MatchToken :: proc() {
     }
     
     if TokenType != .INVALID {
-        append(&DSLTokensList, Common.Token{Type = TokenType, Text = utf8.runes_to_string(TokenText[:])})
+        append(Tokens, Common.Token{Type = TokenType, Text = utf8.runes_to_string(TokenText[:]), Start = TokenStart, End = CurrentTokenIndex + 1})
     }
     
     CurrentTokenIndex += 1
@@ -211,7 +330,92 @@ IsSeparator :: proc(R: rune) -> bool {
 
 // Main tokenizer function
 Tokenize :: proc(Allocator := context.allocator) {
-    for CurrentTokenIndex < len(DSLCodeString) {
-        MatchToken()
+    CloseTokenGap()
+    for CurrentTokenIndex < CodeLength() {
+        MatchToken(&DSLTokensList)
+    }
+    TokenGapStart = len(DSLTokensList)
+    TokenGapEnd = TokenGapStart
+}
+
+// Replaces the runes in [StartIndex, EndIndex) of the tokenized input with Replacement and re-lexes only what changed.
+// Offsets are rune offsets into the input as it was before the edit, matching Token.Start and Token.End.
+// Lexing restarts at the last token far enough before the edit that nothing before it could read the edited runes,
+// and stops as soon as it reaches the start of an old token past the edit. MatchToken carries no state between tokens,
+// so the rest of the list is reused.
+// Both buffers are gap buffers, so the cost is the re-lexed region plus the distance from the previous edit,
+// not the size of the file. Returns false without changing anything if the range is outside the input.
+// Must be called with the same context.allocator as Tokenize because the replaced token texts are freed.
+RetokenizeEdit :: proc(StartIndex, EndIndex: int, Replacement: string) -> (Edit: Common.TokenListEdit, Ok: bool) {
+    if StartIndex < 0 || StartIndex > EndIndex || EndIndex > CodeLength() {
+        return {}, false
+    }
+
+    // Binary search for the number of tokens starting at least MATCH_TOKEN_LOOKAHEAD runes before the edit.
+    // MatchToken calls before such a token, including ones that produced no token, never read the edited runes.
+    Low, High := 0, TokenCount()
+    for Low < High {
+        Middle := (Low + High) / 2
+        if TokenAt(Middle).Start + MATCH_TOKEN_LOOKAHEAD <= StartIndex {
+            Low = Middle + 1
+        } else {
+            High = Middle
+        }
+    }
+
+    // That token may still grow into the replacement, so it is lexed again as well
+    FirstToken := max(Low - 1, 0)
+    RestartIndex := 0
+    if Low > 0 {
+        RestartIndex = TokenAt(FirstToken).Start
+    }
+
+    // From here on every old token from FirstToken is after the gap and stored relative to the end of the input,
+    // so changing the length of the input below shifts all of them without touching them
+    MoveTokenGap(FirstToken)
+
+    ReplacementRunes := utf8.string_to_runes(Replacement)
+    defer delete(ReplacementRunes)
+    MoveCodeGap(StartIndex)
+    CodeGapEnd += EndIndex - StartIndex
+    GrowGap(&DSLCodeString, CodeGapStart, &CodeGapEnd, len(ReplacementRunes))
+    copy(DSLCodeString[CodeGapStart:], ReplacementRunes)
+    CodeGapStart += len(ReplacementRunes)
+
+    EditEnd := CodeGapStart
+    InputLength := CodeLength()
+    NewTokens := make([dynamic]Common.Token)
+    defer delete(NewTokens)
+    RemovedCount := 0
+    Resynced := false
+    CurrentTokenIndex = RestartIndex
+    for CurrentTokenIndex < InputLength {
+        // Old tokens touched by the edit or swallowed by a re-lexed token can never be reused
+        for TokenGapEnd + RemovedCount < len(DSLTokensList) {
+            OldStart := DSLTokensList[TokenGapEnd + RemovedCount].Start + InputLength
+            if OldStart >= EditEnd && OldStart >= CurrentTokenIndex {
+                Resynced = OldStart == CurrentTokenIndex
+                break
+            }
+            RemovedCount += 1
+        }
+        if Resynced {
+            break
+        }
+        MatchToken(&NewTokens)
+    }
+    if !Resynced {
+        RemovedCount = len(DSLTokensList) - TokenGapEnd
     }
+    CurrentTokenIndex = InputLength
+
+    for Token in DSLTokensList[TokenGapEnd:TokenGapEnd + RemovedCount] {
+        delete(Token.Text)
+    }
+    TokenGapEnd += RemovedCount
+    GrowGap(&DSLTokensList, TokenGapStart, &TokenGapEnd, len(NewTokens))
+    copy(DSLTokensList[TokenGapStart:], NewTokens[:])
+    TokenGapStart += len(NewTokens)
+
+    return Common.TokenListEdit{FirstToken = FirstToken, RemovedCount = RemovedCount, InsertedCount = len(NewTokens)}, true
 }
@@ -0,0 +1,160 @@
+package Compiler
+
+import "core:testing"
+import "core:unicode/utf8"
+
+import "Common"
+
+// The tokenizer state is global, so every case lives in one test proc to keep the parallel test runner off it.
+// MatchToken does not free its scratch text, so the test runs on the temp allocator and drops the buffers instead of freeing them.
+
+@(private="file")
+ResetTokenizer :: proc() {
+    DSLTokensList, DSLCodeString = nil, nil
+    CodeGapStart, CodeGapEnd = 0, 0
+    TokenGapStart, TokenGapEnd = 0, 0
+    CurrentTokenIndex = 0
+}
+
+@(private="file")
+// Xorshift, so failures reproduce without depending on the core:math/rand seeding API
+NextRandom :: proc(State: ^u64, Bound: int) -> int {
+    State^ ~= State^ << 13
+    State^ ~= State^ >> 7
+    State^ ~= State^ << 17
+    return int(State^ % u64(Bound))
+}
+
+@(private="file")
+// Compares the incremental tokenizer state against a fresh Tokenize of Text without disturbing either gap
+ExpectMatchesFullTokenize :: proc(t: ^testing.T, Text: []rune, Loc := #caller_location) -> bool {
+    if !testing.expect_value(t, CodeLength(), len(Text), Loc) {
+        return false
+    }
+    for Rune, Index in Text {
+        if !testing.expectf(t, CodeRuneAt(Index) == Rune, "rune %d differs", Index, loc = Loc) {
+            return false
+        }
+    }
+
+    Got := make([dynamic]Common.Token, context.temp_allocator)
+    for Index in 0..<TokenCount() {
+        append(&Got, TokenAt(Index))
+    }
+
+    // Park the incremental state while the reference tokenize runs on the same globals
+    SavedCode, SavedCodeGapStart, SavedCodeGapEnd := DSLCodeString, CodeGapStart, CodeGapEnd
+    SavedTokens, SavedTokenGapStart, SavedTokenGapEnd := DSLTokensList, TokenGapStart, TokenGapEnd
+    SavedIndex := CurrentTokenIndex
+    DSLCodeString, DSLTokensList = nil, nil
+    CodeGapStart, CodeGapEnd, TokenGapStart, TokenGapEnd, CurrentTokenIndex = 0, 0, 0, 0, 0
+
+    InitTokenizerCodeString(utf8.runes_to_string(Text, context.temp_allocator), context.temp_allocator)
+    Tokenize()
+    Expected := TokenList()
+
+    Ok := testing.expectf(t, len(Got) == len(Expected), "got %d tokens, expected %d for %q", len(Got), len(Expected), utf8.runes_to_string(Text, context.temp_allocator), loc = Loc)
+    for Index in 0..<min(len(Got), len(Expected)) {
+        if !Ok {
+            break
+        }
+        Ok = testing.expectf(t, Got[Index] == Expected[Index], "token %d: got %v, expected %v for %q", Index, Got[Index], Expected[Index], utf8.runes_to_string(Text, context.temp_allocator), loc = Loc)
+    }
+
+    ResetTokenizer()
+    DSLCodeString, CodeGapStart, CodeGapEnd = SavedCode, SavedCodeGapStart, SavedCodeGapEnd
+    DSLTokensList, TokenGapStart, TokenGapEnd = SavedTokens, SavedTokenGapStart, SavedTokenGapEnd
+    CurrentTokenIndex = SavedIndex
+    return Ok
+}
+
+@(private="file")
+// Applies the edit to both the tokenizer and the plain copy of the text, then compares them
+ApplyEdit :: proc(t: ^testing.T, Text: ^[dynamic]rune, StartIndex, EndIndex: int, Replacement: string, Loc := #caller_location) -> bool {
+    _, Ok := RetokenizeEdit(StartIndex, EndIndex, Replacement)
+    if !testing.expect(t, Ok, "RetokenizeEdit rejected a valid range", Loc) {
+        return false
+    }
+    remove_range(Text, StartIndex, EndIndex)
+    inject_at_elems(Text, StartIndex, ..utf8.string_to_runes(Replacement, context.temp_allocator))
+    return ExpectMatchesFullTokenize(t, Text[:], Loc)
+}
+
+@(private="file")
+StartTokenizer :: proc(Source: string) -> [dynamic]rune {
+    ResetTokenizer()
+    InitTokenizerCodeString(Source, context.temp_allocator)
+    Tokenize()
+    Text := make([dynamic]rune, context.temp_allocator)
+    append(&Text, ..utf8.string_to_runes(Source, context.temp_allocator))
+    return Text
+}
+
+@(test)
+TestRetokenizeEditMatchesFullTokenize :: proc(t: ^testing.T) {
+    context.allocator = context.temp_allocator
+    defer ResetTokenizer()
+
+    // A failed ' check before the token ending at the edit reads two runes ahead into the edit
+    Text := StartTokenizer("x '(")
+    ApplyEdit(t, &Text, 4, 4, "'")
+    Text = StartTokenizer("b11 '( ;")
+    ApplyEdit(t, &Text, 6, 7, "'")
+
+    // Unterminated strings and comments swallow the rest of the input, closing them must bring the tokens back
+    Text = StartTokenizer("a \"b c d")
+    ApplyEdit(t, &Text, 8, 8, "\" e")
+    ApplyEdit(t, &Text, 2, 3, "")
+    Text = StartTokenizer("a b c")
+    ApplyEdit(t, &Text, 0, 0, "\"")
+    Text = StartTokenizer("a #[ b c")
+    ApplyEdit(t, &Text, 8, 8, " ]# d")
+    ApplyEdit(t, &Text, 10, 12, "")
+
+    // Edits at offset 0 and at the end of the input
+    Text = StartTokenizer("ab cd;")
+    ApplyEdit(t, &Text, 0, 0, "zz")
+    ApplyEdit(t, &Text, 0, 3, "")
+    ApplyEdit(t, &Text, len(Text), len(Text), "e")
+    ApplyEdit(t, &Text, len(Text) - 2, len(Text), "")
+
+    // Out of range edits are rejected without touching the input
+    _, Ok := RetokenizeEdit(2, 1, "")
+    testing.expect(t, !Ok, "reversed range was accepted")
+    _, Ok = RetokenizeEdit(0, len(Text) + 1, "")
+    testing.expect(t, !Ok, "range past the end was accepted")
+    ExpectMatchesFullTokenize(t, Text[:])
+
+    // Appending source after an edit must not reinterpret the tokens stored after the gap
+    Text = StartTokenizer("ab cd ef")
+    ApplyEdit(t, &Text, 0, 1, "x")
+    InitTokenizerCodeString(" gh ij", context.temp_allocator)
+    Tokenize()
+    append(&Text, ..utf8.string_to_runes(" gh ij", context.temp_allocator))
+    ExpectMatchesFullTokenize(t, Text[:])
+
+    // Random edits over a small alphabet that hits every kind of token and lexer failure
+    Alphabet := []rune{'a', 'b', '1', ' ', '"', '\'', '#', '[', ']', '+', '=', ';', '('}
+    State: u64 = 0x9E3779B97F4A7C15
+    Replacement := make([dynamic]rune, context.temp_allocator)
+    for Trial in 0..<500 {
+        clear(&Replacement)
+        for _ in 0..<NextRandom(&State, 40) {
+            append(&Replacement, Alphabet[NextRandom(&State, len(Alphabet))])
+        }
+        Text = StartTokenizer(utf8.runes_to_string(Replacement[:], context.temp_allocator))
+
+        for _ in 0..<8 {
+            StartIndex := NextRandom(&State, len(Text) + 1)
+            EndIndex := StartIndex + NextRandom(&State, min(len(Text) - StartIndex, 4) + 1)
+            clear(&Replacement)
+            for _ in 0..<NextRandom(&State, 5) {
+                append(&Replacement, Alphabet[NextRandom(&State, len(Alphabet))])
+            }
+            if !ApplyEdit(t, &Text, StartIndex, EndIndex, utf8.runes_to_string(Replacement[:], context.temp_allocator)) {
+                testing.expectf(t, false, "random trial %d failed", Trial)
+                return
+            }
+        }
+    }
+}
@@ -3,6 +3,8 @@ package main
 import "core:fmt"
 import "core:mem"
 import "core:mem/virtual"
+import "core:os"
+import "core:strings"
 import "Compiler"
 import "Compiler/Common"
 
@@ -13,7 +15,11 @@ when ODIN_ARCH == .wasm32 || ODIN_ARCH == .wasm64p32 {
 }
 
 
-HELP_MENU :: "dieselc is the C transpiler for the Diesel programing language\n"
+HELP_MENU :: "dieselc is the C transpiler for the Diesel programing language\n" +
+             "usage: dieselc [options] <source file>\n" +
+             "\t--dump=tokens|ast|ir        write a machine readable dump of the given stage\n" +
+             "\t--dump-format=jsonl|binary  encoding used by --dump (default jsonl)\n" +
+             "\t--dump-out=<path>           file written by --dump (default stdout)\n"
 
 
 main :: proc() {
@@ -33,11 +39,76 @@ main :: proc() {
 			virtual.tracking_allocator_destroy(&track)
 		}
 	}
-	fmt.println(HELP_MENU)
-	Compiler.InitTokenizerCodeString("var bob: int8 = 6/2;")
+
+	SourcePath: string
+	DumpRequested := false
+	DumpKind := Common.DumpKind.TOKENS
+	DumpFormat := Common.DumpFormat.JSON_LINES
+	DumpPath: string
+
+	for Arg in os.args[1:] {
+		Ok := true
+		switch {
+		case strings.has_prefix(Arg, "--dump-format="):
+			DumpFormat, Ok = Common.ParseDumpFormat(strings.trim_prefix(Arg, "--dump-format="))
+		case strings.has_prefix(Arg, "--dump-out="):
+			DumpPath = strings.trim_prefix(Arg, "--dump-out=")
+		case strings.has_prefix(Arg, "--dump="):
+			DumpKind, Ok = Common.ParseDumpKind(strings.trim_prefix(Arg, "--dump="))
+			DumpRequested = true
+		case strings.has_prefix(Arg, "-"):
+			Ok = false
+		case SourcePath != "":
+			fmt.eprintfln("dieselc: only one source file can be given, got \"%s\" and \"%s\"", SourcePath, Arg)
+			os.exit(1)
+		case:
+			SourcePath = Arg
+		}
+		if !Ok {
+			fmt.eprintfln("dieselc: invalid option \"%s\"", Arg)
+			fmt.eprint(HELP_MENU)
+			os.exit(1)
+		}
+	}
+
+	if DumpRequested && DumpKind != .TOKENS {
+		fmt.eprintfln("dieselc: --dump=%s is not available yet, the parser and IR compiler do not produce output", strings.to_lower(fmt.tprint(DumpKind), context.temp_allocator))
+		os.exit(1)
+	}
+
+	if SourcePath == "" {
+		// The dump owns stdout, so the help banner is only shown for the human readable listing
+		if !DumpRequested {
+			fmt.println(HELP_MENU)
+		}
+		Compiler.InitTokenizerCodeString("var bob: int8 = 6/2;")
+	} else {
+		Source, Ok := os.read_entire_file(SourcePath)
+		if !Ok {
+			fmt.eprintfln("dieselc: could not read \"%s\"", SourcePath)
+			os.exit(1)
+		}
+		defer delete(Source)
+		Compiler.InitTokenizerCodeString(string(Source))
+	}
 	Compiler.Tokenize()
-	token: Common.Token 
-	for &token in Compiler.DSLTokensList {
-		Common.PrintToken(&token)
+
+	if !DumpRequested {
+		Tokens := Compiler.TokenList()
+		for &token in Tokens {
+			Common.PrintToken(&token)
+		}
+		return
 	}
-}
\ No newline at end of file
+
+	DumpOk: bool
+	if DumpPath == "" {
+		DumpOk = Common.DumpTokens(Compiler.TokenList(), os.stream_from_handle(os.stdout), DumpFormat)
+	} else {
+		DumpOk = Common.DumpTokensToFile(Compiler.TokenList(), DumpPath, DumpFormat)
+	}
+	if !DumpOk {
+		fmt.eprintln("dieselc: failed to write token dump")
+		os.exit(1)
+	}
+}